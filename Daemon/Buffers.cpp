@@ -0,0 +1,70 @@
+#include "Buffers.h"
+
+void InputBuffer::reset(const std::string &data) {
+    // the get area is only ever read from, so dropping const is safe
+    char *start = const_cast<char *>(data.data());
+    setg(start, start, start + data.size());
+}
+
+InputBuffer::pos_type InputBuffer::seekoff(off_type offset, std::ios_base::seekdir direction,
+                                           std::ios_base::openmode which) {
+    if (!(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+
+    // work out the new position relative to the start of the data
+    off_type base = 0;
+    if (direction == std::ios_base::cur) {
+        base = gptr() - eback();
+    } else if (direction == std::ios_base::end) {
+        base = egptr() - eback();
+    }
+    off_type position = base + offset;
+    if (position < 0 || position > egptr() - eback()) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), eback() + position, egptr());
+    return pos_type(position);
+}
+
+InputBuffer::pos_type InputBuffer::seekpos(pos_type position, std::ios_base::openmode which) {
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+OutputBuffer::OutputBuffer() {
+    target = nullptr;
+}
+
+void OutputBuffer::reset(std::string &target) {
+    // clear() keeps the string's capacity, which is the point of reusing it
+    target.clear();
+    this->target = &target;
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type value) {
+    if (target == nullptr) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(value, traits_type::eof())) {
+        target->push_back(traits_type::to_char_type(value));
+    }
+    return traits_type::not_eof(value);
+}
+
+std::streamsize OutputBuffer::xsputn(const char *data, std::streamsize size) {
+    if (target == nullptr) {
+        return 0;
+    }
+    target->append(data, size);
+    return size;
+}
+
+OutputBuffer::pos_type OutputBuffer::seekoff(off_type offset, std::ios_base::seekdir direction,
+                                             std::ios_base::openmode which) {
+    // only telling the position is supported, which is all Huffman's stats need
+    if (target == nullptr || offset != 0 || direction != std::ios_base::cur || !(which & std::ios_base::out)) {
+        return pos_type(off_type(-1));
+    }
+    return pos_type(off_type(target->size()));
+}
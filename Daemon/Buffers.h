@@ -0,0 +1,52 @@
+#include <string>
+#include <streambuf>
+
+#ifndef BUFFERS_H
+#define BUFFERS_H
+
+/**
+ * @class InputBuffer
+ *
+ * Stream buffer that reads straight out of an existing string without copying it,
+ * so a request payload can be handed to Huffman as an std::istream. Supports seeking,
+ * which Huffman::compress needs for its second pass.
+ */
+class InputBuffer : public std::streambuf {
+public:
+    /**
+     * Points the buffer at new data and rewinds it to the start
+     * @param data the string to read from, must outlive any reads
+     */
+    void reset(const std::string &data);
+
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+};
+
+/**
+ * @class OutputBuffer
+ *
+ * Stream buffer that appends everything written to it to an existing string, so Huffman
+ * can write its result straight into a response payload that keeps its capacity between requests.
+ */
+class OutputBuffer : public std::streambuf {
+public:
+    OutputBuffer();
+
+    /**
+     * Empties a string and starts appending to it
+     * @param target the string to write to, must outlive any writes
+     */
+    void reset(std::string &target);
+
+protected:
+    int_type overflow(int_type value) override;
+    std::streamsize xsputn(const char *data, std::streamsize size) override;
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+
+private:
+    std::string *target;    // the string being written to
+};
+
+#endif //BUFFERS_H
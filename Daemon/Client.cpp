@@ -0,0 +1,97 @@
+#include "Client.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+Client::Client(const std::string &socket_path) {
+    checksums = false;
+    mode = "huffman";
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long.");
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create socket.");
+    }
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to connect to " + socket_path + ".");
+    }
+}
+
+Client::~Client() {
+    close(fd);
+}
+
+void Client::setChecksums(bool enabled) {
+    checksums = enabled;
+}
+
+void Client::setMode(const std::string &mode) {
+    if (mode != "huffman" && mode != "stored" && mode != "auto") {
+        throw std::runtime_error("Unknown mode: " + mode + ".");
+    }
+    this->mode = mode;
+}
+
+void Client::compress(const std::string &input_file, const std::string &output_file) {
+    unsigned char flags = checksums ? FLAG_CHECKSUMS : 0;
+    if (mode == "stored") {
+        flags |= FLAG_STORED;
+    } else if (mode == "auto") {
+        flags |= FLAG_AUTO;
+    }
+    send(REQUEST_COMPRESS, flags, input_file);
+    writeResponse(output_file);
+}
+
+void Client::decompress(const std::string &input_file, const std::string &output_file) {
+    send(REQUEST_DECOMPRESS, 0, input_file);
+    writeResponse(output_file);
+}
+
+void Client::verify(const std::string &input_file) {
+    send(REQUEST_VERIFY, 0, input_file);
+}
+
+void Client::send(unsigned char type, unsigned char flags, const std::string &input_file) {
+    // read the whole input file into the request
+    std::ifstream input(input_file, std::ios::in | std::ios::binary);
+    if (!input.is_open()) {
+        throw std::runtime_error("Failed to open input file.");
+    }
+    std::ostringstream contents;
+    contents << input.rdbuf();
+    request.type = type;
+    request.flags = flags;
+    request.payload = contents.str();
+
+    // send it and wait for the answer
+    // a daemon that refuses a request can answer and hang up before taking all of it,
+    // so look for its error even if the write failed
+    bool sent = writeFrame(fd, request);
+    if (!readFrame(fd, response, MAX_PAYLOAD_SIZE) || (!sent && response.type != RESPONSE_ERROR)) {
+        throw std::runtime_error("Lost connection to the daemon.");
+    }
+    if (response.type != RESPONSE_OK) {
+        throw std::runtime_error(response.payload);
+    }
+}
+
+void Client::writeResponse(const std::string &output_file) {
+    std::ofstream output(output_file, std::ios::out | std::ios::binary);
+    if (!output.is_open()) {
+        throw std::runtime_error("Failed to open output file.");
+    }
+    output.write(response.payload.data(), response.payload.size());
+}
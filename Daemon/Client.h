@@ -0,0 +1,83 @@
+#include <string>
+#include "Protocol.h"
+
+#ifndef CLIENT_H
+#define CLIENT_H
+
+/**
+ * @class Client
+ *
+ * Sends compress and decompress requests to a running huffman daemon (see Server) over its
+ * Unix domain socket. A single client may send any number of requests over one connection.
+ */
+class Client {
+private:
+    int fd;             // the connection to the daemon
+    Frame request;      // reusable request frame
+    Frame response;     // reusable response frame
+    bool checksums;     // ask for per block checksums when compressing
+    std::string mode;   // coding mode to ask for when compressing
+
+    /**
+     * Sends a file's contents as a request and waits for the response
+     * @param type the request type
+     * @param flags the request flags
+     * @param input_file the file to send
+     */
+    void send(unsigned char type, unsigned char flags, const std::string &input_file);
+
+    /**
+     * Writes the payload of the last response to a file
+     * @param output_file the file to write the result to
+     */
+    void writeResponse(const std::string &output_file);
+
+public:
+    /**
+     * Connects to a daemon
+     * @param socket_path path of the daemon's Unix domain socket
+     */
+    explicit Client(const std::string &socket_path);
+
+    /**
+     * Destructor, closes the connection
+     */
+    ~Client();
+
+    /**
+     * Turns per block checksums on or off for files compressed from now on, see Huffman::setChecksums
+     * @param enabled true to store checksums
+     */
+    void setChecksums(bool enabled);
+
+    /**
+     * Sets the coding mode for files compressed from now on, see Huffman::setMode.
+     * "auto" always aims for the best ratio, as with a tolerance of 0.
+     * @param mode "huffman", "stored" or "auto"
+     * @throws std::runtime_error if the mode is unknown
+     */
+    void setMode(const std::string &mode);
+
+    /**
+     * Asks the daemon to compress a file
+     * @param input_file the file to compress
+     * @param output_file the compressed file
+     */
+    void compress(const std::string &input_file, const std::string &output_file);
+
+    /**
+     * Asks the daemon to decompress a file
+     * @param input_file the file to decompress
+     * @param output_file the decompressed file
+     */
+    void decompress(const std::string &input_file, const std::string &output_file);
+
+    /**
+     * Asks the daemon to check that a compressed file is intact, see Huffman::verify
+     * @param input_file the file to check
+     * @throws std::runtime_error describing the first problem found
+     */
+    void verify(const std::string &input_file);
+};
+
+#endif //CLIENT_H
@@ -0,0 +1,268 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Protocol.h"
+#include "Buffers.h"
+#include "Server.h"
+#include "Client.h"
+
+// number of checks that failed
+static int failures = 0;
+
+/**
+ * Records the result of a check and prints it
+ * @param passed whether the check passed
+ * @param name what was checked
+ */
+void check(bool passed, const std::string &name) {
+    std::cout << (passed ? "PASS: " : "FAIL: ") << name << std::endl;
+    if (!passed) {
+        failures++;
+    }
+}
+
+/**
+ * Writes a string to a file
+ * @param path the file to write
+ * @param contents what to write into it
+ */
+void writeFile(const std::string &path, const std::string &contents) {
+    std::ofstream output(path, std::ios::out | std::ios::binary);
+    output << contents;
+}
+
+/**
+ * Reads a whole file into a string
+ * @param path the file to read
+ * @return the file's contents, empty if it can't be read
+ */
+std::string readFile(const std::string &path) {
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    std::ostringstream contents;
+    contents << input.rdbuf();
+    return contents.str();
+}
+
+/**
+ * Connects to a server that may still be starting up
+ * @param socket_path the server's socket
+ * @return nullptr if nothing answered within a few seconds
+ */
+Client *connectClient(const std::string &socket_path) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+        try {
+            return new Client(socket_path);
+        } catch (const std::runtime_error &) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Checks sending frames across a socket pair
+ */
+void checkFrames() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+
+    // a frame with every byte value, followed by an empty one, comes back unchanged
+    Frame sent;
+    sent.type = REQUEST_COMPRESS;
+    sent.flags = FLAG_CHECKSUMS;
+    for (int i = 0; i < 256 * 4; i++) {
+        sent.payload.push_back(static_cast<char>(i));
+    }
+    Frame empty;
+    empty.type = RESPONSE_OK;
+    Frame received;
+    bool passed = writeFrame(fds[0], sent) && readFrame(fds[1], received, MAX_PAYLOAD_SIZE);
+    check(passed && received.type == sent.type && received.flags == sent.flags && received.payload == sent.payload,
+          "frame round trip");
+    passed = writeFrame(fds[0], empty) && readFrame(fds[1], received, MAX_PAYLOAD_SIZE);
+    check(passed && received.type == RESPONSE_OK && received.payload.empty(), "empty frame round trip");
+
+    // a payload over the limit is refused once its size has been read
+    check(writeFrame(fds[0], sent) && !readFrame(fds[1], received, sent.payload.size() - 1), "oversized length");
+
+    // nothing arriving by the deadline is a failed read, not a hang
+    int quiet[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, quiet);
+    auto start = std::chrono::steady_clock::now();
+    passed = !readFrame(quiet[1], received, MAX_PAYLOAD_SIZE, start + std::chrono::milliseconds(100));
+    check(passed && std::chrono::steady_clock::now() - start < std::chrono::seconds(5), "read deadline");
+    close(quiet[0]);
+    close(quiet[1]);
+
+    // a peer that hangs up part way through the fixed size header
+    check(writeFully(fds[0], "C\x01\x05\x00\x00", 5), "write partial header");
+    close(fds[0]);
+    check(!readFrame(fds[1], received, MAX_PAYLOAD_SIZE), "truncated header");
+    close(fds[1]);
+}
+
+/**
+ * Checks the stream buffers that wrap request and response payloads
+ */
+void checkBuffers() {
+    std::string data = "hello world";
+    InputBuffer input_buffer;
+    input_buffer.reset(data);
+    std::istream input(&input_buffer);
+    std::string word;
+    input >> word;
+    check(word == "hello", "input buffer reads");
+    input.seekg(0, std::ios::end);
+    check(input.tellg() == std::streampos(11), "input buffer seeks to the end");
+    input.seekg(6);
+    input >> word;
+    check(word == "world", "input buffer seeks back");
+    input.clear();
+    input.seekg(12);
+    check(input.fail(), "input buffer refuses to seek past the end");
+    input.clear();
+    input.seekg(-1, std::ios::cur);
+    check(!input.fail() && input.tellg() == std::streampos(10), "input buffer seeks relative to the position");
+
+    std::string target = "left over";
+    OutputBuffer output_buffer;
+    output_buffer.reset(target);
+    std::ostream output(&output_buffer);
+    output << "compressed" << 42;
+    check(target == "compressed42" && output.tellp() == std::streampos(12), "output buffer writes in place");
+}
+
+/**
+ * Checks a compress, decompress and verify exchange with a server on a temporary socket
+ * @param directory a scratch directory for the socket and files
+ */
+void checkServer(const std::string &directory) {
+    std::string socket_path = directory + "/huffman.sock";
+    std::string text;
+    for (int i = 0; i < 5000; i++) {
+        text += "the quick brown fox jumps over the lazy dog " + std::to_string(i) + "\n";
+    }
+    writeFile(directory + "/input.txt", text);
+
+    Server server(socket_path, 2, 1 << 20);
+    std::thread running([&server] {
+        try {
+            server.run();
+        } catch (const std::exception &e) {
+            std::cout << "server failed: " << e.what() << std::endl;
+        }
+    });
+
+    Client *client = connectClient(socket_path);
+    check(client != nullptr, "client connects");
+    if (client != nullptr) {
+        try {
+            client->setChecksums(true);
+            client->compress(directory + "/input.txt", directory + "/input.huf");
+            client->verify(directory + "/input.huf");
+            client->decompress(directory + "/input.huf", directory + "/output.txt");
+            check(readFile(directory + "/output.txt") == text, "compress, verify and decompress round trip");
+        } catch (const std::exception &e) {
+            check(false, std::string("compress, verify and decompress round trip (") + e.what() + ")");
+        }
+
+        // errors come back as messages, and the connection stays usable
+        std::string damaged = readFile(directory + "/input.huf");
+        damaged[damaged.size() / 2] ^= 0x10;
+        writeFile(directory + "/damaged.huf", damaged);
+        std::string error;
+        try {
+            client->verify(directory + "/damaged.huf");
+        } catch (const std::runtime_error &e) {
+            error = e.what();
+        }
+        check(error.find("checksum mismatch") != std::string::npos, "verify reports damage (" + error + ")");
+        try {
+            client->verify(directory + "/input.huf");
+            check(true, "connection survives an error");
+        } catch (const std::exception &e) {
+            check(false, std::string("connection survives an error (") + e.what() + ")");
+        }
+
+        // the mode travels with the request, so binary data Huffman mode can't code still gets through
+        std::string binary = text + '\0' + text;
+        writeFile(directory + "/binary.bin", binary);
+        try {
+            client->setMode("auto");
+            client->compress(directory + "/binary.bin", directory + "/binary.huf");
+            client->setMode("huffman");
+            client->decompress(directory + "/binary.huf", directory + "/binary.out");
+            check(readFile(directory + "/binary.out") == binary, "auto mode round trip through the daemon");
+        } catch (const std::exception &e) {
+            check(false, std::string("auto mode round trip through the daemon (") + e.what() + ")");
+        }
+
+        // a request over the server's 1 MiB limit gets the error rather than a dropped connection
+        std::string big;
+        while (big.size() <= (1 << 20)) {
+            big += text;
+        }
+        writeFile(directory + "/big.txt", big);
+        error.clear();
+        try {
+            client->compress(directory + "/big.txt", directory + "/big.huf");
+        } catch (const std::runtime_error &e) {
+            error = e.what();
+        }
+        check(error.find("byte limit") != std::string::npos, "request over the limit is refused (" + error + ")");
+        try {
+            client->verify(directory + "/input.huf");
+            check(true, "connection survives a refused request");
+        } catch (const std::exception &e) {
+            check(false, std::string("connection survives a refused request (") + e.what() + ")");
+        }
+        delete client;
+    }
+
+    // a second server must not take over the socket of one that is running
+    Server second(socket_path, 1);
+    std::string error;
+    try {
+        second.run();
+    } catch (const std::runtime_error &e) {
+        error = e.what();
+    }
+    check(error.find("already listening") != std::string::npos, "second server refuses a live socket (" + error + ")");
+
+    server.stop();
+    running.join();
+    struct stat removed;
+    check(lstat(socket_path.c_str(), &removed) != 0, "server removes its socket");
+}
+
+int main() {
+    checkFrames();
+    checkBuffers();
+
+    char directory[] = "/tmp/huffman-daemon-XXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        check(false, "create a scratch directory");
+    } else {
+        checkServer(directory);
+        for (const char *name : {"/input.txt", "/input.huf", "/output.txt", "/damaged.huf", "/big.txt", "/big.huf",
+                                 "/binary.bin", "/binary.huf", "/binary.out"}) {
+            unlink((std::string(directory) + name).c_str());
+        }
+        rmdir(directory);
+    }
+
+    if (failures > 0) {
+        std::cout << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}
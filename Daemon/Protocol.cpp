@@ -0,0 +1,131 @@
+#include "Protocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * Waits until a socket is ready to read or write, or the deadline passes
+ * @param fd the socket to wait on
+ * @param events POLLIN or POLLOUT
+ * @param deadline when to give up
+ * @return true if the socket is ready, false on error or timeout
+ */
+static bool waitUntil(int fd, short events, Deadline deadline) {
+    if (deadline == NO_DEADLINE) {
+        return true;
+    }
+    while (true) {
+        // round up so we don't spin on a deadline that is less than a millisecond away
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now() + std::chrono::microseconds(999));
+        if (remaining.count() <= 0) {
+            return false;
+        }
+        pollfd ready = {fd, events, 0};
+        int result = poll(&ready, 1, static_cast<int>(std::min<long long>(remaining.count(), 1 << 30)));
+        // retry if a signal interrupted the wait
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        return result > 0;
+    }
+}
+
+bool readFully(int fd, void *data, size_t size, Deadline deadline) {
+    char *position = static_cast<char *>(data);
+    while (size > 0) {
+        if (!waitUntil(fd, POLLIN, deadline)) {
+            return false;
+        }
+        ssize_t count = read(fd, position, size);
+        // retry if a signal interrupted the read
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        // an error, or the peer closed the socket before we got everything
+        if (count <= 0) {
+            return false;
+        }
+        position += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool writeFully(int fd, const void *data, size_t size, Deadline deadline) {
+    const char *position = static_cast<const char *>(data);
+    // MSG_NOSIGNAL so a client hanging up doesn't kill us with SIGPIPE
+    // with a deadline, only send what fits so we never block past it
+    int flags = MSG_NOSIGNAL | (deadline != NO_DEADLINE ? MSG_DONTWAIT : 0);
+    while (size > 0) {
+        if (!waitUntil(fd, POLLOUT, deadline)) {
+            return false;
+        }
+        ssize_t count = send(fd, position, size, flags);
+        // retry if a signal interrupted the write, or the socket filled up again
+        if (count < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        position += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool readFrameHeader(int fd, Frame &frame, uint64_t &size, Deadline deadline) {
+    // read the fixed size part of the frame
+    unsigned char prefix[2];
+    if (!readFully(fd, prefix, sizeof(prefix), deadline) || !readFully(fd, &size, sizeof(size), deadline)) {
+        return false;
+    }
+    frame.type = prefix[0];
+    frame.flags = prefix[1];
+    return true;
+}
+
+bool readPayload(int fd, Frame &frame, uint64_t size, Deadline deadline) {
+    // read a chunk at a time so a sender can't make us allocate memory it never fills
+    const uint64_t chunk_size = 1 << 20;
+    frame.payload.clear();
+    while (size > 0) {
+        size_t count = std::min(size, chunk_size);
+        size_t position = frame.payload.size();
+        frame.payload.resize(position + count);
+        if (!readFully(fd, &frame.payload[position], count, deadline)) {
+            return false;
+        }
+        size -= count;
+    }
+    return true;
+}
+
+bool discardPayload(int fd, uint64_t size, Deadline deadline) {
+    char discarded[1 << 16];
+    while (size > 0) {
+        size_t count = std::min<uint64_t>(size, sizeof(discarded));
+        if (!readFully(fd, discarded, count, deadline)) {
+            return false;
+        }
+        size -= count;
+    }
+    return true;
+}
+
+bool readFrame(int fd, Frame &frame, uint64_t max_size, Deadline deadline) {
+    uint64_t size;
+    return readFrameHeader(fd, frame, size, deadline) && size <= max_size
+           && readPayload(fd, frame, size, deadline);
+}
+
+bool writeFrame(int fd, const Frame &frame, Deadline deadline) {
+    unsigned char prefix[2] = {frame.type, frame.flags};
+    uint64_t size = frame.payload.size();
+    return writeFully(fd, prefix, sizeof(prefix), deadline)
+           && writeFully(fd, &size, sizeof(size), deadline)
+           && writeFully(fd, frame.payload.data(), frame.payload.size(), deadline);
+}
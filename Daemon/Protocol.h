@@ -0,0 +1,124 @@
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/**
+ * Wire format shared by the huffman daemon (Server) and its client (Client).
+ *
+ * Every request and response is a frame of the form:
+ * [1 byte type][1 byte flags][8 byte payload length][payload]
+ * The length is in host byte order since both ends always live on the same machine.
+ * A connection may carry any number of request/response pairs; the server keeps
+ * answering until the client closes its end.
+ */
+
+// request types
+const unsigned char REQUEST_COMPRESS = 'C';   // payload is the data to compress
+const unsigned char REQUEST_DECOMPRESS = 'D'; // payload is a compressed stream
+const unsigned char REQUEST_VERIFY = 'V';     // payload is a compressed stream, response is empty
+
+// request flags
+const unsigned char FLAG_CHECKSUMS = 0x01;    // compress with per block checksums
+const unsigned char FLAG_STORED = 0x02;       // compress in stored mode rather than Huffman coding
+const unsigned char FLAG_AUTO = 0x04;         // let "auto" pick the mode for the best ratio
+
+// response types
+const unsigned char RESPONSE_OK = 'K';        // payload is the result
+const unsigned char RESPONSE_ERROR = 'E';     // payload is an error message
+
+// largest response payload the client will accept, guards against garbage lengths
+const uint64_t MAX_PAYLOAD_SIZE = 1ULL << 32;
+// largest request payload the server accepts unless told otherwise
+const uint64_t DEFAULT_MAX_REQUEST_SIZE = 1ULL << 28;
+
+// point in time by which a whole frame must have been sent or received
+typedef std::chrono::steady_clock::time_point Deadline;
+// for callers that will wait as long as it takes
+const Deadline NO_DEADLINE = Deadline::max();
+
+/**
+ * A single request or response exchanged over the socket
+ */
+struct Frame {
+    unsigned char type = 0;  // one of the REQUEST_ or RESPONSE_ constants
+    unsigned char flags = 0; // FLAG_ constants for requests, 0 for responses
+    std::string payload;     // the data carried by the frame
+};
+
+/**
+ * Reads exactly size bytes from a socket, retrying on short reads and interrupts
+ * @param fd the socket to read from
+ * @param data where to store the bytes
+ * @param size how many bytes to read
+ * @param deadline when to give up waiting for the bytes
+ * @return true if all bytes were read, false on error, timeout or if the peer closed the socket
+ */
+bool readFully(int fd, void *data, size_t size, Deadline deadline = NO_DEADLINE);
+
+/**
+ * Writes exactly size bytes to a socket, retrying on short writes and interrupts
+ * @param fd the socket to write to
+ * @param data the bytes to write
+ * @param size how many bytes to write
+ * @param deadline when to give up waiting for the peer to take the bytes
+ * @return true if all bytes were written, false on error or timeout
+ */
+bool writeFully(int fd, const void *data, size_t size, Deadline deadline = NO_DEADLINE);
+
+/**
+ * Reads the fixed size start of the next frame, so the caller can check the payload size
+ * before reading the payload with readPayload
+ * @param fd the socket to read from
+ * @param frame the frame's type and flags are passed back through the pass by reference parameter
+ * @param size the payload size is passed back through the pass by reference parameter
+ * @param deadline when to give up waiting for the bytes
+ * @return true if the start of a frame was read, false on error, timeout or a closed socket
+ */
+bool readFrameHeader(int fd, Frame &frame, uint64_t &size, Deadline deadline = NO_DEADLINE);
+
+/**
+ * Reads a frame's payload. The buffer grows as bytes arrive rather than trusting the size
+ * up front, and keeps its capacity from earlier frames.
+ * @param fd the socket to read from
+ * @param frame the payload is passed back through the pass by reference parameter
+ * @param size the payload size from readFrameHeader
+ * @param deadline when to give up waiting for the bytes
+ * @return true if the whole payload was read, false on error, timeout or a closed socket
+ * @throws std::bad_alloc if the payload doesn't fit in memory
+ */
+bool readPayload(int fd, Frame &frame, uint64_t size, Deadline deadline = NO_DEADLINE);
+
+/**
+ * Reads a frame's payload and throws it away, without holding more than a small buffer of it
+ * @param fd the socket to read from
+ * @param size the payload size from readFrameHeader
+ * @param deadline when to give up waiting for the bytes
+ * @return true if the whole payload was read, false on error, timeout or a closed socket
+ */
+bool discardPayload(int fd, uint64_t size, Deadline deadline = NO_DEADLINE);
+
+/**
+ * Reads the next frame from a socket
+ * @param fd the socket to read from
+ * @param frame the frame is passed back through the pass by reference parameter
+ * @param max_size the largest payload to accept
+ * @param deadline when to give up waiting for the rest of the frame
+ * @return true if a whole frame was read, false on error, timeout, oversized payload or a closed socket
+ * @throws std::bad_alloc if the payload doesn't fit in memory
+ */
+bool readFrame(int fd, Frame &frame, uint64_t max_size, Deadline deadline = NO_DEADLINE);
+
+/**
+ * Writes a frame to a socket
+ * @param fd the socket to write to
+ * @param frame the frame to send
+ * @param deadline when to give up waiting for the peer to take the frame
+ * @return true if the whole frame was written, false on error or timeout
+ */
+bool writeFrame(int fd, const Frame &frame, Deadline deadline = NO_DEADLINE);
+
+#endif //PROTOCOL_H
@@ -0,0 +1,312 @@
+#include "Server.h"
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// set by the signal handler to ask the accept loop to stop
+static volatile std::sig_atomic_t stop_requested = 0;
+
+// how long a client gets to send a whole request, or to read a whole response
+static const int CLIENT_TIMEOUT_SECONDS = 30;
+// largest over-limit request we read and throw away so that the client gets our error back
+static const uint64_t MAX_DISCARD_SIZE = 1ULL << 30;
+
+/**
+ * Signal handler for SIGINT and SIGTERM
+ */
+static void requestStop(int) {
+    stop_requested = 1;
+}
+
+Server::Server(const std::string &socket_path, unsigned int thread_count, uint64_t max_request_size) {
+    this->socket_path = socket_path;
+    this->thread_count = thread_count > 0 ? thread_count : 1;
+    this->max_request_size = max_request_size;
+    this->listen_fd = -1;
+    this->wake_pipe[0] = -1;
+    this->wake_pipe[1] = -1;
+    this->stopping = false;
+    this->stop_called = false;
+}
+
+Server::~Server() {
+    if (listen_fd >= 0) {
+        close(listen_fd);
+    }
+    if (wake_pipe[0] >= 0) {
+        close(wake_pipe[0]);
+        close(wake_pipe[1]);
+    }
+}
+
+void Server::run() {
+    // make sure the path fits in a socket address
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long.");
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    // replace a stale socket file left by an earlier run, but never any other kind of file,
+    // and never the socket of a daemon that is still answering on it
+    struct stat existing;
+    if (lstat(socket_path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            throw std::runtime_error(socket_path + ": path exists and is not a socket.");
+        }
+        int probe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = probe_fd >= 0 && connect(probe_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+        if (probe_fd >= 0) {
+            close(probe_fd);
+        }
+        if (live) {
+            throw std::runtime_error(socket_path + ": another daemon is already listening on this socket.");
+        }
+        unlink(socket_path.c_str());
+    }
+
+    // create the listening socket
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        throw std::runtime_error("Failed to create socket.");
+    }
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0
+        || listen(listen_fd, SOMAXCONN) < 0) {
+        throw std::runtime_error("Failed to listen on " + socket_path + ".");
+    }
+
+    // stop cleanly on Ctrl-C or a service manager's SIGTERM
+    stop_requested = 0;
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    // workers write to this pipe when they hand a connection back, so poll wakes up for it
+    if (pipe(wake_pipe) < 0) {
+        throw std::runtime_error("Failed to create pipe.");
+    }
+    fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+
+    // start the worker pool
+    for (unsigned int i = 0; i < thread_count; i++) {
+        workers.emplace_back(&Server::workerLoop, this);
+    }
+
+    // connections waiting for their next request, only touched by this thread
+    std::vector<int> idle;
+    std::vector<pollfd> fds;
+
+    // accept connections and queue each request for the workers as it arrives
+    // poll with a timeout so a stop request is noticed even if nothing happens
+    while (!stop_requested && !stop_called) {
+        fds.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        fds.push_back({wake_pipe[0], POLLIN, 0});
+        for (int client_fd : idle) {
+            fds.push_back({client_fd, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), 500) <= 0) {
+            continue;
+        }
+
+        // anything readable has a request (or a hang up) for a worker, the rest stay idle
+        idle.clear();
+        std::vector<int> ready;
+        for (size_t i = 2; i < fds.size(); i++) {
+            if (fds[i].revents != 0) {
+                ready.push_back(fds[i].fd);
+            } else {
+                idle.push_back(fds[i].fd);
+            }
+        }
+
+        // empty the wake up pipe, then pick up the connections workers are done with
+        char drained[64];
+        while (read(wake_pipe[0], drained, sizeof(drained)) > 0) {
+        }
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            idle.insert(idle.end(), returned.begin(), returned.end());
+            returned.clear();
+            for (int client_fd : ready) {
+                pending.push(client_fd);
+            }
+        }
+        if (!ready.empty()) {
+            pending_ready.notify_all();
+        }
+
+        if (fds[0].revents != 0) {
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            if (client_fd >= 0) {
+                idle.push_back(client_fd);
+            }
+        }
+    }
+
+    // wake up idle workers and unblock the ones waiting on a client
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        stopping = true;
+        for (int client_fd : active) {
+            shutdown(client_fd, SHUT_RDWR);
+        }
+    }
+    pending_ready.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // drop every connection that is still open
+    for (int client_fd : idle) {
+        close(client_fd);
+    }
+    for (int client_fd : returned) {
+        close(client_fd);
+    }
+    returned.clear();
+    while (!pending.empty()) {
+        close(pending.front());
+        pending.pop();
+    }
+
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = -1;
+    wake_pipe[1] = -1;
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(socket_path.c_str());
+}
+
+void Server::stop() {
+    stop_called = true;
+}
+
+void Server::workerLoop() {
+    // per worker state kept alive across requests so we don't start cold every time
+    Scratch scratch;
+
+    while (true) {
+        int client_fd;
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex);
+            pending_ready.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            client_fd = pending.front();
+            pending.pop();
+            active.insert(client_fd);
+        }
+
+        bool keep = serveRequest(client_fd, scratch);
+
+        // hand the connection back to the poll loop for its next request, or close it
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            active.erase(client_fd);
+            keep = keep && !stopping;
+            if (keep) {
+                returned.push_back(client_fd);
+            }
+        }
+        if (keep) {
+            char wake = 0;
+            ssize_t ignored = write(wake_pipe[1], &wake, 1);
+            (void) ignored;
+        } else {
+            close(client_fd);
+        }
+    }
+}
+
+bool Server::serveRequest(int client_fd, Scratch &scratch) {
+    Frame &request = scratch.request;
+    Frame &response = scratch.response;
+
+    // a client that stalls part way through a frame gives up its worker once the deadline passes,
+    // however it spaces out its bytes
+    Deadline deadline = std::chrono::steady_clock::now() + std::chrono::seconds(CLIENT_TIMEOUT_SECONDS);
+
+    // a failed read means the client hung up, timed out or sent something we can't parse
+    uint64_t size;
+    if (!readFrameHeader(client_fd, request, size, deadline)) {
+        return false;
+    }
+
+    // refuse a request over the limit, but read its payload first: a client still sending would see
+    // its write fail rather than our error. Past MAX_DISCARD_SIZE that isn't worth it, so we just
+    // answer and drop the connection, and the client picks up the error if it still arrives
+    response.type = RESPONSE_ERROR;
+    response.flags = 0;
+    if (size > max_request_size) {
+        response.payload = "Request of " + std::to_string(size) + " bytes is over the "
+                           + std::to_string(max_request_size) + " byte limit.";
+        bool discarded = size <= MAX_DISCARD_SIZE && discardPayload(client_fd, size, deadline);
+        return writeFrame(client_fd, response, deadline) && discarded;
+    }
+    try {
+        if (!readPayload(client_fd, request, size, deadline)) {
+            return false;
+        }
+    } catch (const std::bad_alloc &) {
+        response.payload = "Out of memory reading request.";
+        writeFrame(client_fd, response, deadline);
+        return false;
+    }
+
+    // the response gets its own deadline, however long the work took
+    process(scratch);
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(CLIENT_TIMEOUT_SECONDS);
+    return writeFrame(client_fd, response, deadline);
+}
+
+void Server::process(Scratch &scratch) {
+    const Frame &request = scratch.request;
+    Frame &response = scratch.response;
+    response.flags = 0;
+    try {
+        // read the request and write the result in place, without copying either
+        scratch.input_buffer.reset(request.payload);
+        scratch.input.clear();
+        scratch.output_buffer.reset(response.payload);
+        scratch.output.clear();
+
+        if (request.type == REQUEST_COMPRESS) {
+            scratch.huffman.setChecksums((request.flags & FLAG_CHECKSUMS) != 0);
+            // the Huffman instance is reused, so every request sets the mode
+            if (request.flags & FLAG_STORED) {
+                scratch.huffman.setMode("stored");
+            } else if (request.flags & FLAG_AUTO) {
+                scratch.huffman.setMode("auto");
+            } else {
+                scratch.huffman.setMode("huffman");
+            }
+            scratch.huffman.compress(scratch.input, scratch.output);
+        } else if (request.type == REQUEST_DECOMPRESS) {
+            scratch.huffman.decompress(scratch.input, scratch.output);
+        } else if (request.type == REQUEST_VERIFY) {
+            scratch.huffman.verify(scratch.input);
+        } else {
+            throw std::runtime_error("Unknown request type.");
+        }
+        response.type = RESPONSE_OK;
+    } catch (const std::exception &e) {
+        response.type = RESPONSE_ERROR;
+        response.payload = e.what();
+    }
+}
@@ -0,0 +1,104 @@
+#include <string>
+#include <vector>
+#include <queue>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include "Protocol.h"
+#include "Buffers.h"
+#include "../Huffman.h"
+
+#ifndef SERVER_H
+#define SERVER_H
+
+/**
+ * @class Server
+ *
+ * Long running daemon that serves compress and decompress requests over a Unix domain
+ * socket, so callers don't pay process start up for every file. The main thread polls all
+ * open connections and hands each request to a fixed pool of worker threads as it arrives,
+ * so idle connections don't tie up a worker. Each worker keeps its own Huffman instance and
+ * request/response buffers alive between requests so their memory stays warm.
+ * See Protocol.h for the wire format.
+ */
+class Server {
+private:
+    /**
+     * Everything a worker reuses from one request to the next
+     */
+    struct Scratch {
+        Huffman huffman;            // the worker's compressor
+        Frame request;              // the request being served, its payload keeps its capacity
+        Frame response;             // the response being built, its payload keeps its capacity
+        InputBuffer input_buffer;   // reads the request payload in place
+        OutputBuffer output_buffer; // writes straight into the response payload
+        std::istream input;         // stream over input_buffer
+        std::ostream output;        // stream over output_buffer
+
+        Scratch() : input(&input_buffer), output(&output_buffer) {}
+    };
+
+    std::string socket_path;                // path the listening socket is bound to
+    unsigned int thread_count;              // number of worker threads
+    uint64_t max_request_size;              // largest request payload to accept
+    int listen_fd;                          // the listening socket
+    int wake_pipe[2];                       // written to by workers to wake up the poll loop
+    std::vector<std::thread> workers;       // the worker pool
+    std::queue<int> pending;                // connections with a request waiting for a worker
+    std::vector<int> returned;              // connections handed back by workers after a request
+    std::unordered_set<int> active;         // connections a worker is currently serving
+    std::mutex pending_mutex;               // guards pending, returned, active and stopping
+    std::condition_variable pending_ready;  // signalled when pending changes or we stop
+    bool stopping;                          // set once the server is shutting down
+    std::atomic<bool> stop_called;          // set by stop() to end run() as if signalled
+
+    /**
+     * Main loop of a worker thread: serves one request at a time off the queue until the server stops
+     */
+    void workerLoop();
+
+    /**
+     * Reads, runs and answers a single request on a connection
+     * @param client_fd the connected socket, which has data waiting
+     * @param scratch the worker's reusable state
+     * @return true if the connection can be used for another request, false if it should be closed
+     */
+    bool serveRequest(int client_fd, Scratch &scratch);
+
+    /**
+     * Runs the request in scratch and fills in its response, errors are reported in the response
+     * @param scratch the worker's reusable state holding the request
+     */
+    void process(Scratch &scratch);
+
+public:
+    /**
+     * Parameterized constructor
+     * @param socket_path path of the Unix domain socket to listen on
+     * @param thread_count number of worker threads, at least 1
+     * @param max_request_size largest request payload to accept, bigger requests get an error
+     */
+    Server(const std::string &socket_path, unsigned int thread_count,
+           uint64_t max_request_size = DEFAULT_MAX_REQUEST_SIZE);
+
+    /**
+     * Destructor, closes the listening socket if it is still open
+     */
+    ~Server();
+
+    /**
+     * Binds the socket and serves requests until SIGINT or SIGTERM is received or stop is called, then waits
+     * for the workers to finish and removes the socket file
+     */
+    void run();
+
+    /**
+     * Asks run() to stop as if SIGINT had been received, may be called from any thread
+     */
+    void stop();
+};
+
+#endif //SERVER_H
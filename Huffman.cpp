@@ -1,49 +1,208 @@
 #include "Huffman.h"
+#include <algorithm>
+#include <cmath>
 
-void Huffman::compress(const std::string &input_file, const std::string &output_file) {
-    // make a frequency table for chars
-    std::unordered_map<char, int> frequency = createFrequencyTable(input_file);
-    // build the Huffman tree based on the created table
-    buildHuffmanTree(frequency);
-    // encode the file using our Huffman tree
-    encodeFile(input_file, output_file);
-    // free the memory allocated by the tree
+// "auto" keeps between 64 KiB and 4 MiB per block, aiming for about this many blocks per file
+static const unsigned int AUTO_MIN_BLOCK_SIZE = 1 << 16;
+static const unsigned int AUTO_MAX_BLOCK_SIZE = 1 << 22;
+static const unsigned long long AUTO_TARGET_BLOCKS = 64;
+
+Huffman::Huffman() {
+    // start without a tree so freeTree() is safe before the first run
+    root = nullptr;
+    checksums = false;
+    mode = "huffman";
+    tolerance = 0;
+    block_size = 0;
+}
+
+Huffman::~Huffman() {
+    // free a tree left behind if a run threw part way through
     freeTree();
 }
 
+void Huffman::setChecksums(bool enabled) {
+    checksums = enabled;
+}
+
+void Huffman::setMode(const std::string &mode) {
+    if (mode != "huffman" && mode != "stored" && mode != "auto") {
+        throw std::runtime_error("Unknown mode: " + mode + ".");
+    }
+    this->mode = mode;
+}
+
+void Huffman::setTolerance(double percent) {
+    // written so NaN fails too, since every comparison with it is false
+    if (!std::isfinite(percent) || !(percent >= 0 && percent <= 100)) {
+        throw std::runtime_error("Tolerance must be between 0 and 100.");
+    }
+    tolerance = percent;
+}
+
+void Huffman::setBlockSize(unsigned int size) {
+    if (size > Storage::MAX_BLOCK_SIZE) {
+        throw std::runtime_error("Block size is too large.");
+    }
+    block_size = size;
+}
+
+const Huffman::Stats &Huffman::getStats() const {
+    return stats;
+}
+
+void Huffman::compress(const std::string &input_file, const std::string &output_file) {
+    // open the input file
+    std::ifstream huffman_input(input_file, std::ios::in | std::ios::binary);
+    // throw an error if we can't open our input file
+    if (!huffman_input.is_open()) {
+        throw std::runtime_error("Failed to open input file.");
+    }
+
+    // open the output file
+    std::ofstream huffman_output(output_file, std::ios::out | std::ios::binary);
+    // throw an error if we cannot open the output file
+    if (!huffman_output.is_open()) {
+        throw std::runtime_error("Failed to open output file.");
+    }
+
+    compress(huffman_input, huffman_output);
+}
+
 void Huffman::decompress(const std::string &input_file, const std::string &output_file) {
+    // open the input file
+    std::ifstream huffman_input(input_file, std::ios::in | std::ios::binary);
+    // throw an error if we can't open our input file
+    if (!huffman_input.is_open()) {
+        throw std::runtime_error("Failed to open input file for reading.");
+    }
+
+    // open the file to output in
+    std::ofstream decoded_file(output_file, std::ios::out | std::ios::binary);
+    // throw an error if we cannot open the file
+    if (!decoded_file.is_open()) {
+        throw std::runtime_error("Failed to open output file.");
+    }
+
+    decompress(huffman_input, decoded_file);
+}
+
+void Huffman::verify(const std::string &input_file) {
+    // open the input file
+    std::ifstream huffman_input(input_file, std::ios::in | std::ios::binary);
+    // throw an error if we can't open our input file
+    if (!huffman_input.is_open()) {
+        throw std::runtime_error("Failed to open input file for reading.");
+    }
+
+    verify(huffman_input);
+}
+
+void Huffman::compress(std::istream &input, std::ostream &output) {
+    // remember where the data starts so we can come back to it for encoding
+    std::streampos start = input.tellg();
+    std::streampos output_start = output.tellp();
+
+    // measure the input for the stats
+    stats = Stats();
+    input.seekg(0, std::ios::end);
+    stats.input_bytes = input.tellg() - start;
+    input.seekg(start);
+
+    // use the requested settings, unless we are asked to pick them
+    stats.mode = mode;
+    stats.block_size = block_size != 0 ? block_size : Storage::BLOCK_SIZE;
+    if (mode == "auto") {
+        chooseSettings(input);
+    }
+    // only checksummed files record their block size, otherwise it is just the size of each write
+    unsigned int size = stats.block_size;
+    if (!checksums) {
+        stats.block_size = 0;
+    }
+
+    if (stats.mode == "stored") {
+        storeFile(input, output, size, stats.input_bytes);
+    } else {
+        // make a frequency table for chars
+        std::unordered_map<char, int> frequency = createFrequencyTable(input);
+        // rewind the input for the second pass
+        input.clear();
+        input.seekg(start);
+        if (input.fail()) {
+            throw std::runtime_error("Failed to rewind input.");
+        }
+
+        // the null char marks inner nodes and the EOF char ends decoding, so neither can be coded
+        // "auto" promises a lossless result, so store data containing them instead
+        // explicit Huffman mode refuses rather than write a file that can't be read back
+        bool uncodable = frequency.count('\0') || frequency['\x03'] > 1;
+        if (uncodable && !stats.automatic) {
+            throw std::runtime_error("Input contains NUL/ETX bytes, which Huffman mode cannot code; "
+                                     "compress it in stored or auto mode.");
+        }
+        if (uncodable) {
+            stats.mode = "stored";
+            stats.reason = "input contains bytes Huffman mode cannot code";
+            storeFile(input, output, size, stats.input_bytes);
+        } else {
+            // build the Huffman tree based on the created table
+            buildHuffmanTree(frequency);
+            // encode the file using our Huffman tree
+            encodeFile(input, output, size);
+            // free the memory allocated by the tree
+            freeTree();
+        }
+    }
+
+    // streams that can't tell their position just report no output size
+    std::streampos output_end = output.tellp();
+    if (output_start != std::streampos(-1) && output_end != std::streampos(-1)) {
+        stats.output_bytes = output_end - output_start;
+    }
+}
+
+void Huffman::decompress(std::istream &input, std::ostream &output) {
     // decode the file
-    decodeFile(input_file, output_file);
+    decodeFile(input, output);
     // free the memory allocated by the tree
     freeTree();
 }
 
-std::unordered_map<char, int> Huffman::createFrequencyTable(const std::string& input_file) {
+void Huffman::verify(std::istream &input) {
+    // decode into a stream with no buffer, which discards everything written to it
+    std::ostream null_sink(nullptr);
+    decodeFile(input, null_sink);
+    // free the memory allocated by the tree
+    freeTree();
+}
+
+std::unordered_map<char, int> Huffman::createFrequencyTable(std::istream &input) {
     // make a map to store the frequencies in
     // the char is each unique character in the file
     // the int is the amount of times it appears in the file
     std::unordered_map<char, int> frequency;
 
-    // open the file
-    std::ifstream huffman_input(input_file);
     char current_char;
 
     // read characters from the file until there are no more characters to be read
-    while (huffman_input.get(current_char)) {
+    while (input.get(current_char)) {
         // increment the frequency of the character
         frequency[current_char]++;
     }
 
     // EOF char that only appears once
-    frequency['\x03'] = 1;
+    // counted on top of any EOF chars in the input, so compress() can tell they were there
+    frequency['\x03']++;
 
     // return the map with the frequencies of each character
     return frequency;
 }
 
 void Huffman::buildHuffmanTree(const std::unordered_map<char, int> &frequency) {
-    // ensures the tree is clear before we try building it
+    // ensures the tree and codes from a previous run are clear before we try building it
     freeTree();
+    huffman_codes.clear();
 
     // make a queue to store the nodes
     // the lowest weight nodes have the highest priority
@@ -102,20 +261,99 @@ void Huffman::generateHuffmanCodes(Node *tree, const std::string &code_string) {
     generateHuffmanCodes(tree->one, code_string + "1");
 }
 
-void Huffman::encodeFile(const std::string &input_file, const std::string &output_file) {
-    // open the input file
-    std::ifstream huffman_input;
-    huffman_input.open(input_file);
-    // throw an error if we can't open our input file
-    if (!huffman_input.is_open()) {
-        throw std::runtime_error("Failed to open input file.");
+void Huffman::chooseSettings(std::istream &input) {
+    // build a histogram of the first block
+    std::streampos start = input.tellg();
+    std::string sample(Storage::BLOCK_SIZE, '\0');
+    input.read(&sample[0], sample.size());
+    sample.resize(input.gcount());
+    input.clear();
+    input.seekg(start);
+
+    unsigned long long histogram[256] = {};
+    for (char current_char : sample) {
+        histogram[static_cast<unsigned char>(current_char)]++;
+    }
+
+    // order-0 entropy, plus the header cost: each char takes itself, its code and a separator,
+    // and a code is about -log2(p) bits long, written out as one byte per bit
+    double entropy = 0;
+    double header = 4 + 3;  // the size field, and the EOF char's record
+    for (unsigned long long count : histogram) {
+        if (count == 0) {
+            continue;
+        }
+        double probability = static_cast<double>(count) / sample.size();
+        entropy -= probability * std::log2(probability);
+        header += 2 + std::max(1.0, std::ceil(-std::log2(probability)));
+    }
+
+    stats.automatic = true;
+    stats.sample_bytes = sample.size();
+    stats.entropy = entropy;
+    stats.header_estimate = static_cast<unsigned long long>(header);
+    // estimate the coded size of the whole input from the sample, stored mode is ratio 1
+    if (stats.input_bytes > 0) {
+        stats.estimated_ratio = (entropy / 8 * stats.input_bytes + header) / stats.input_bytes;
     }
 
-    // open storage to write in the output file
-    // throw error if we cannot open the output file
-    if (!storage.open(output_file, "write")) {
+    // stored mode (ratio 1) is fastest, so take it unless its ratio is more than tolerance percent
+    // worse than the best ratio available, i.e. 1 / estimated_ratio > 1 + tolerance / 100
+    if (stats.input_bytes == 0 || stats.estimated_ratio * (1 + tolerance / 100) >= 1) {
+        stats.mode = "stored";
+        stats.reason = "stored ratio within tolerance of the estimated best";
+    } else {
+        stats.mode = "huffman";
+        stats.reason = "estimated huffman ratio beats stored by more than tolerance";
+    }
+
+    // unless a size was given, use bigger blocks for bigger files to keep per block costs down
+    // only checksums are per block, so without them the default is as good as any
+    if (block_size == 0 && checksums) {
+        unsigned int size = AUTO_MIN_BLOCK_SIZE;
+        while (size < AUTO_MAX_BLOCK_SIZE && stats.input_bytes / size > AUTO_TARGET_BLOCKS) {
+            size *= 2;
+        }
+        stats.block_size = size;
+    }
+}
+
+void Huffman::storeFile(std::istream &input, std::ostream &output, unsigned int size, unsigned long long length) {
+    // open storage to write in the output stream
+    // throw error if we cannot write to the output
+    if (!storage.openWriter(output)) {
         throw std::runtime_error("Failed to open output file.");
     }
+    storage.setChecksums(checksums);
+    storage.setBlockSize(size);
+    storage.setStored(true);
+
+    // stored data needs no code table, the header records its length instead
+    storage.setHeader(std::string(reinterpret_cast<const char *>(&length), 8));
+
+    // copy the input across a block at a time
+    std::string data(size, '\0');
+    unsigned long long copied = 0;
+    while (input.read(&data[0], data.size()) || input.gcount() > 0) {
+        storage.insertBytes(data.data(), input.gcount());
+        copied += input.gcount();
+    }
+    if (copied != length) {
+        throw std::runtime_error("Input changed size while it was being stored.");
+    }
+
+    // close the file
+    storage.close();
+}
+
+void Huffman::encodeFile(std::istream &input, std::ostream &output, unsigned int size) {
+    // open storage to write in the output stream
+    // throw error if we cannot write to the output
+    if (!storage.openWriter(output)) {
+        throw std::runtime_error("Failed to open output file.");
+    }
+    storage.setChecksums(checksums);
+    storage.setBlockSize(size);
 
     // make an iterator
     std::unordered_map<char, std::string>::iterator it;
@@ -138,14 +376,11 @@ void Huffman::encodeFile(const std::string &input_file, const std::string &outpu
     char current_char;
 
     // read each character from the input file
-    while (huffman_input.get(current_char)) {
+    while (input.get(current_char)) {
         // insert the encoded binary into the output file as soon as we read it in
         storage.insert(huffman_codes[current_char]);
     }
 
-    // close file since we don't need it anymore
-    huffman_input.close();
-
     // add flag to signify that we reached the end of the file
     // 'x03' is an ASCII char that signifies EOF
     storage.insert(huffman_codes['\x03']);
@@ -154,23 +389,42 @@ void Huffman::encodeFile(const std::string &input_file, const std::string &outpu
     storage.close();
 }
 
-void Huffman::decodeFile(const std::string &input_file, const std::string &output_file) {
-    // open the storage to read from the file
-    if (!storage.open(input_file, "read")) {
+void Huffman::decodeFile(std::istream &input, std::ostream &output) {
+    // open the storage to read from the stream
+    if (!storage.openReader(input)) {
         throw std::runtime_error("Failed to open input file for reading.");
     }
 
-    // open the file to output in
-    std::ofstream decoded_file;
-    decoded_file.open(output_file);
+    // get the header
+    std::string header = storage.getHeader();
 
-    // throw an error if we cannot open the file
-    if (!decoded_file.is_open()) {
-        throw std::runtime_error("Failed to open output file.");
+    // stored data is copied straight out, its header is just the data length
+    if (storage.isStored()) {
+        if (header.size() != 8) {
+            throw std::runtime_error("Corrupt header: stored data with a code table.");
+        }
+        unsigned long long length;
+        header.copy(reinterpret_cast<char *>(&length), 8);
+        unsigned long long copied = 0;
+        std::string bytes;
+        while (storage.extractBytes(bytes)) {
+            copied += bytes.size();
+            if (copied > length) {
+                throw std::runtime_error("Corrupt data: unexpected bytes after end of stream.");
+            }
+            output.write(bytes.data(), bytes.size());
+        }
+        if (copied < length) {
+            throw std::runtime_error("Corrupt data: stored data is truncated.");
+        }
+        storage.close();
+        return;
     }
 
-    // get the header
-    std::string header = storage.getHeader();
+    // Huffman coded data always has at least the EOF char's code
+    if (header.empty()) {
+        throw std::runtime_error("Corrupt header: empty code table.");
+    }
 
     // reconstruct the tree
     reconstructTree(header);
@@ -179,9 +433,11 @@ void Huffman::decodeFile(const std::string &input_file, const std::string &outpu
     std::string file_bits;
     // start at the root of the tree
     Node* current_node = root;
+    // an input with nothing but the EOF char is a lone leaf with no bits to read
+    bool finished = root->letter == '\x03';
 
     // iterate through each bit stored in the binary string
-    while (storage.extract(file_bits)) {
+    while (!finished && storage.extract(file_bits)) {
         for (char bit : file_bits) {
             // if the bit is 0, then go to the zero position (left)
             if (bit == '0') {
@@ -191,27 +447,42 @@ void Huffman::decodeFile(const std::string &input_file, const std::string &outpu
                 current_node = current_node->one;
             }
 
+            // a missing branch means the bits don't match any code in the header
+            if (current_node == nullptr) {
+                throw std::runtime_error("Corrupt data: invalid code.");
+            }
+
             // if it's a leaf node, then it must contain a char
             if (current_node->letter != '\0') {
-                // if we reach our EOF char, break
+                // if we reach our EOF char, stop decoding
                 if (current_node->letter == '\x03') {
+                    finished = true;
                     break;
                 }
                 // output the char
-                decoded_file << current_node->letter;
+                output << current_node->letter;
                 // reset to root after each outputted char
                 current_node = root;
             }
         }
     }
 
-    // close the files
-    decoded_file.close();
-    // close the file opened for reading
+    // the encoder always writes the EOF char, and nothing but padding after it
+    if (!finished) {
+        throw std::runtime_error("Corrupt data: missing end of stream.");
+    }
+    if (storage.extract(file_bits)) {
+        throw std::runtime_error("Corrupt data: unexpected bytes after end of stream.");
+    }
+
+    // close the storage opened for reading
     storage.close();
 }
 
 void Huffman::reconstructTree(std::string &header) {
+    // ensures a tree left over from a failed run is freed first
+    freeTree();
+
     // make a map to store the reconstructed Huffman tree in
     std::unordered_map<char, std::string> reconstructed_code_map;
     // variable to store the position of our record separator
@@ -219,7 +490,8 @@ void Huffman::reconstructTree(std::string &header) {
 
     // loop keeps running as long as there is a record separator in between each position
     // if find() cannot find the record separator, it returns npos
-    while ((position = header.find("\36")) != std::string::npos) {
+    // the search starts after the encoded char, which may itself be a record separator
+    while ((position = header.find('\36', 1)) != std::string::npos) {
         // the first char is the encoded char
         char encoded_char = header[0];
         // after the encoded char, its Huffman code follows
@@ -245,6 +517,10 @@ void Huffman::reconstructTree(std::string &header) {
 
         // traverse the string of code, bit by bit
         for (char bit : code) {
+            // codes may not pass through another char's leaf
+            if (current->letter != '\0') {
+                throw std::runtime_error("Corrupt header: conflicting codes.");
+            }
             if (bit == '0') {
                 // if the 0 node isn't already created, create it
                 if (!current->zero) {
@@ -252,15 +528,21 @@ void Huffman::reconstructTree(std::string &header) {
                 }
                 // move to the zero child
                 current = current->zero;
-            } else { // bit == '1'
+            } else if (bit == '1') {
                 // if the 1 node isn't already created, create it
                 if (!current->one) {
                     current->one = new Node('\0', 0);  // Create a right child with dummy values
                 }
                 // move to the one child
                 current = current->one;
+            } else {
+                throw std::runtime_error("Corrupt header: invalid code.");
             }
         }
+        // two chars can't share a leaf, and a leaf can't have children
+        if (current->letter != '\0' || current->zero || current->one) {
+            throw std::runtime_error("Corrupt header: conflicting codes.");
+        }
         // after all the bits are traversed, we have reached a leaf node that contains the char
         current->letter = letter;
     }
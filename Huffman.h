@@ -1,6 +1,7 @@
 #include <string>
 #include <queue>
 #include <fstream>
+#include <iostream>
 #include <unordered_map>
 #include "Node.h"
 #include "Storage/Storage.h"
@@ -15,17 +16,39 @@
  * compression algorithm.
  */
 class Huffman {
+public:
+    /**
+     * Numbers describing the last call to compress(), see setMode("auto")
+     */
+    struct Stats {
+        unsigned long long input_bytes = 0;     // size of the uncompressed input
+        unsigned long long output_bytes = 0;    // size of the compressed output
+        std::string mode;                       // coding mode used, "huffman" or "stored"
+        unsigned int block_size = 0;            // block size recorded in the file, 0 without checksums
+        bool automatic = false;                 // true if the mode and block size were picked by "auto"
+        unsigned long long sample_bytes = 0;    // bytes the auto estimate was made from
+        double entropy = 0;                     // order-0 entropy of the sample, in bits per byte
+        unsigned long long header_estimate = 0; // estimated Huffman header size, in bytes
+        double estimated_ratio = 0;             // estimated compressed size / input size for Huffman coding
+        std::string reason;                     // why auto picked the mode it did
+    };
+
 private:
     Node* root;                                          // the tree's root
     std::unordered_map<char, std::string> huffman_codes; // map to store all the huffman codes
     Storage storage;                                     // storage used to store binary code
+    bool checksums;                                      // store a CRC32C with every block when compressing
+    std::string mode;                                    // "huffman", "stored" or "auto"
+    double tolerance;                                    // ratio loss in percent of the best "auto" may trade for speed
+    unsigned int block_size;                             // block size to compress with, 0 for the default
+    Stats stats;                                         // numbers from the last compress
 
     /**
      * Creates a frequency table for how often the file's characters appear
-     * @param input_file the file to read from
+     * @param input the stream to read from
      * @return unordered_map with frequency of each character in the text file
      */
-    std::unordered_map<char, int> createFrequencyTable(const std::string &input_file);
+    std::unordered_map<char, int> createFrequencyTable(std::istream &input);
 
     /**
      * Builds a Huffman tree based on a given map of a char and its frequency
@@ -41,23 +64,43 @@ private:
     void generateHuffmanCodes(Node* root, const std::string& code_string);
 
     /**
-     * Encodes the input file and prints the encoded version into the output file
-     * @param input_file the file to be encoded
-     * @param output_file the encoded file
+     * Picks the coding mode and block size for "auto" from the first block of the input,
+     * and records the estimate and choice in stats
+     * @param input the seekable stream to be compressed, left where it started
+     */
+    void chooseSettings(std::istream& input);
+
+    /**
+     * Encodes the input stream and prints the encoded version into the output stream
+     * @param input the stream to be encoded
+     * @param output the stream the encoded data is written to
+     * @param size the block size to write with
      */
-    void encodeFile(const std::string& input_file, const std::string& output_file);
+    void encodeFile(std::istream& input, std::ostream& output, unsigned int size);
 
     /**
-     * Decodes the input file and prints the decoded version into the output file
-     * @param input_file the file to be decoded
-     * @param output_file the decoded file
+     * Copies the input stream into the output stream without coding it, in a file marked as stored
+     * @param input the stream to be stored
+     * @param output the stream the stored data is written to
+     * @param size the block size to write with
+     * @param length the number of bytes in the input, recorded in the header
+     * @throws std::runtime_error if the input doesn't hold exactly length bytes
      */
-    void decodeFile(const std::string& input_file, const std::string& output_file);
+    void storeFile(std::istream& input, std::ostream& output, unsigned int size, unsigned long long length);
+
+    /**
+     * Decodes the input stream and prints the decoded version into the output stream
+     * @param input the stream to be decoded
+     * @param output the stream the decoded data is written to
+     * @throws std::runtime_error if the stream is damaged
+     */
+    void decodeFile(std::istream& input, std::ostream& output);
 
     /**
      * Reconstructs a Huffman tree given a header containing chars and their respective Huffman codes
      * Note: the header needs to be in [char][Huffman code][\36] format to work
      * @param header the header from which the tree can be reconstructed from
+     * @throws std::runtime_error if the header doesn't describe a valid tree
      */
     void reconstructTree(std::string &header);
 
@@ -73,6 +116,61 @@ private:
     void freeNodes(Node* node);
 
 public:
+    /**
+     * Default constructor, starts with an empty tree
+     */
+    Huffman();
+
+    /**
+     * Destructor, frees any tree left over from a failed run
+     */
+    ~Huffman();
+
+    /**
+     * Turns per block CRC32C checksums on or off for files compressed from now on.
+     * Files with checksums can be checked with verify(), and are checked on every decompress.
+     * Off by default.
+     *
+     * @param enabled true to store checksums
+     */
+    void setChecksums(bool enabled);
+
+    /**
+     * Sets how files are compressed from now on. "huffman" (the default) Huffman codes the
+     * data. "stored" copies it as is, which is fastest and never grows data by more than the
+     * header. "auto" estimates the order-0 entropy and header cost from the first block of
+     * the input and picks the mode, and the block size if checksums are on, see setTolerance.
+     * Only "huffman" is readable by versions without stored mode.
+     *
+     * @param mode "huffman", "stored" or "auto"
+     */
+    void setMode(const std::string &mode);
+
+    /**
+     * Sets how much compression "auto" may give up for speed. Stored mode is picked when its
+     * ratio is within this many percent of the best estimated ratio, so 10 allows a file up to
+     * 10% bigger than Huffman coding is estimated to make it. 0 means "max ratio".
+     *
+     * @param percent the ratio loss allowed, in percent of the best ratio
+     * @throws std::runtime_error unless percent is between 0 and 100
+     */
+    void setTolerance(double percent);
+
+    /**
+     * Sets the block size used when compressing, which is also the unit checksums cover.
+     * 0 (the default) uses 64 KiB, or lets "auto" pick one.
+     *
+     * @param size bytes per block, up to Storage::MAX_BLOCK_SIZE
+     */
+    void setBlockSize(unsigned int size);
+
+    /**
+     * Returns numbers describing the last call to compress(), including the choices made by "auto"
+     *
+     * @return the stats
+     */
+    const Stats &getStats() const;
+
     /**
      * Compresses a given input file using Huffman compression and outputs the compressed
      * version to another file
@@ -90,6 +188,42 @@ public:
      * @param output_file the decompressed file
      */
     void decompress(const std::string &input_file, const std::string &output_file);
+
+    /**
+     * Compresses a stream using Huffman compression. The input is read twice (once to
+     * count frequencies and once to encode), so it must be seekable.
+     *
+     * @param input the seekable stream to compress
+     * @param output the stream the compressed data is written to
+     * @throws std::runtime_error in "huffman" mode if the input contains NUL or ETX bytes,
+     * which that mode cannot code
+     */
+    void compress(std::istream &input, std::ostream &output);
+
+    /**
+     * Decompresses a stream that used Huffman compression
+     *
+     * @param input the stream to decompress
+     * @param output the stream the decompressed data is written to
+     */
+    void decompress(std::istream &input, std::ostream &output);
+
+    /**
+     * Checks that a compressed file is intact by fully decoding it without writing the
+     * output anywhere. Block checksums are checked too if the file has them.
+     *
+     * @param input_file the file to check
+     * @throws std::runtime_error describing the first problem found
+     */
+    void verify(const std::string &input_file);
+
+    /**
+     * Checks that a compressed stream is intact, see verify(const std::string&)
+     *
+     * @param input the stream to check
+     * @throws std::runtime_error describing the first problem found
+     */
+    void verify(std::istream &input);
 };
 
 #endif //HUFFMAN_H
@@ -1,37 +1,218 @@
 #include <iostream>
+#include <iomanip>
+#include <cmath>
 #include <string>
+#include <vector>
+#include <thread>
 #include "Huffman.h"
+#include "Daemon/Server.h"
+#include "Daemon/Client.h"
+
+// most worker threads serve will start
+const unsigned int MAX_THREADS = 256;
 
 /**
  * Prints how to use command to user
  */
 void printInstructions() {
     std::cout << "How to use:\n"
-              << "huffman compress <input_file> <output_file>\n"
-              << "huffman decompress <input_file> <output_file>\n";
+              << "huffman compress [options] <input_file> <output_file>\n"
+              << "huffman decompress <input_file> <output_file>\n"
+              << "huffman verify <input_file>\n"
+              << "huffman serve [--max-request=<bytes>] <socket_path> [threads]\n"
+              << "huffman client <socket_path> [--checksum] [--mode=huffman|stored|auto] [--auto=ratio]\n"
+              << "               compress <input_file> <output_file>\n"
+              << "huffman client <socket_path> decompress <input_file> <output_file>\n"
+              << "huffman client <socket_path> verify <input_file>\n"
+              << "compress options:\n"
+              << "  --checksum                store a CRC32C with every block\n"
+              << "  --mode=huffman|stored     coding mode, huffman by default\n"
+              << "  --auto=ratio[:<percent>]  pick mode and block size, for a ratio within <percent>% of the best\n"
+              << "  --auto=throughput         preset for --auto=ratio:10\n"
+              << "  --block-size=<bytes>      bytes per block\n"
+              << "  --stats                   print sizes and the settings used\n";
 }
 
-int main(int argc, char* argv[]) {
-    // if incorrect number of args provided, show how to use command
-    if (argc != 4) {
-        printInstructions();
-        return 1;
+/**
+ * Prints the stats from a compression, including what "auto" chose and why
+ * @param stats the stats to print
+ */
+void printStats(const Huffman::Stats &stats) {
+    std::cout << "input bytes: " << stats.input_bytes << "\n"
+              << "output bytes: " << stats.output_bytes << "\n";
+    if (stats.input_bytes > 0) {
+        std::cout << "ratio: " << std::fixed << std::setprecision(4)
+                  << static_cast<double>(stats.output_bytes) / stats.input_bytes << "\n";
+    }
+    std::cout << "mode: " << stats.mode << (stats.automatic ? " (auto)" : "") << "\n";
+    // files without checksums don't record a block size
+    if (stats.block_size > 0) {
+        std::cout << "block size: " << stats.block_size << "\n";
     }
+    if (stats.automatic) {
+        std::cout << "sample bytes: " << stats.sample_bytes << "\n"
+                  << "entropy: " << std::fixed << std::setprecision(4) << stats.entropy << " bits/byte\n"
+                  << "header estimate: " << stats.header_estimate << " bytes\n"
+                  << "estimated huffman ratio: " << stats.estimated_ratio << "\n"
+                  << "reason: " << stats.reason << "\n";
+    }
+}
 
-    // either compress or decompress
-    std::string command = argv[1];
-    std::string input_file = argv[2];
-    std::string output_file = argv[3];
+/**
+ * Reads a decimal number such as the 2.5 in --auto=ratio:2.5
+ * @param text the text holding the number
+ * @param name what the number is, for the error message
+ * @return the number
+ */
+double parseNumber(const std::string &text, const std::string &name) {
+    // only digits and a decimal point, so "nan", "inf", "-1" and "1e3" are rejected
+    size_t end = 0;
+    double value = 0;
+    bool valid = !text.empty() && text.find_first_not_of("0123456789.") == std::string::npos;
+    if (valid) {
+        try {
+            value = std::stod(text, &end);
+        } catch (const std::logic_error &) {
+            valid = false;
+        }
+    }
+    if (!valid || end != text.size() || !std::isfinite(value)) {
+        throw std::runtime_error("Invalid " + name + ": " + text + " (expected a number such as 2.5).");
+    }
+    return value;
+}
 
-    Huffman huffman;
+/**
+ * Reads a whole number such as the 65536 in --block-size=65536
+ * @param text the text holding the number
+ * @param name what the number is, for the error message
+ * @param max the largest value allowed
+ * @return the number
+ */
+unsigned long long parseCount(const std::string &text, const std::string &name, unsigned long long max) {
+    // only plain digits, so "-1", "1.5" and "1e3" are rejected rather than half parsed
+    unsigned long long value = 0;
+    bool valid = !text.empty() && text.find_first_not_of("0123456789") == std::string::npos;
+    if (valid) {
+        try {
+            value = std::stoull(text);
+        } catch (const std::out_of_range &) {
+            valid = false;
+        }
+    }
+    if (!valid || value > max) {
+        throw std::runtime_error("Invalid " + name + ": " + text + " (expected a whole number up to "
+                                 + std::to_string(max) + ").");
+    }
+    return value;
+}
 
+int main(int argc, char* argv[]) {
     try {
-        if (command == "compress") {
-            huffman.compress(input_file, output_file);
-            std::cout << "Compression completed: " << output_file << std::endl;
-        } else if (command == "decompress") {
-            huffman.decompress(input_file, output_file);
-            std::cout << "Decompression completed: " << output_file << std::endl;
+        // split the arguments into --options and positional arguments
+        std::vector<std::string> args;
+        bool checksums = false;
+        bool show_stats = false;
+        std::string mode = "huffman";
+        double tolerance = 0;
+        unsigned int block_size = 0;
+        uint64_t max_request_size = DEFAULT_MAX_REQUEST_SIZE;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--checksum") {
+                checksums = true;
+            } else if (arg == "--stats") {
+                show_stats = true;
+            } else if (arg.compare(0, 7, "--mode=") == 0) {
+                mode = arg.substr(7);
+            } else if (arg == "--auto=throughput") {
+                // a named preset: stored mode, the fastest, whenever its ratio is within 10% of the best
+                mode = "auto";
+                tolerance = 10;
+            } else if (arg == "--auto=ratio") {
+                mode = "auto";
+                tolerance = 0;
+            } else if (arg.compare(0, 13, "--auto=ratio:") == 0) {
+                mode = "auto";
+                tolerance = parseNumber(arg.substr(13), "tolerance");
+            } else if (arg.compare(0, 13, "--block-size=") == 0) {
+                block_size = parseCount(arg.substr(13), "block size", Storage::MAX_BLOCK_SIZE);
+            } else if (arg.compare(0, 14, "--max-request=") == 0) {
+                max_request_size = parseCount(arg.substr(14), "request size", MAX_PAYLOAD_SIZE);
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "Unknown option: " << arg << "\n";
+                printInstructions();
+                return 1;
+            } else {
+                args.push_back(arg);
+            }
+        }
+
+        // if no command provided, show how to use command
+        if (args.empty()) {
+            printInstructions();
+            return 1;
+        }
+
+        // compress, decompress, verify, serve or client
+        std::string command = args[0];
+
+        if (command == "compress" && args.size() == 3) {
+            Huffman huffman;
+            huffman.setChecksums(checksums);
+            huffman.setMode(mode);
+            huffman.setTolerance(tolerance);
+            huffman.setBlockSize(block_size);
+            huffman.compress(args[1], args[2]);
+            std::cout << "Compression completed: " << args[2] << std::endl;
+            if (show_stats) {
+                printStats(huffman.getStats());
+            }
+        } else if (command == "decompress" && args.size() == 3) {
+            Huffman huffman;
+            huffman.decompress(args[1], args[2]);
+            std::cout << "Decompression completed: " << args[2] << std::endl;
+        } else if (command == "verify" && args.size() == 2) {
+            Huffman huffman;
+            huffman.verify(args[1]);
+            std::cout << "Verification passed: " << args[1] << std::endl;
+        } else if (command == "serve" && (args.size() == 2 || args.size() == 3)) {
+            // default to one worker per core
+            unsigned int threads = std::thread::hardware_concurrency();
+            if (args.size() == 3) {
+                threads = parseCount(args[2], "thread count", MAX_THREADS);
+                if (threads == 0) {
+                    throw std::runtime_error("Invalid thread count: 0 (expected at least 1).");
+                }
+            }
+
+            Server server(args[1], threads, max_request_size);
+            std::cout << "Serving on " << args[1] << std::endl;
+            server.run();
+        } else if (command == "client" && args.size() >= 3) {
+            std::string operation = args[2];
+            // the daemon's auto mode always aims for the best ratio
+            if (tolerance != 0) {
+                throw std::runtime_error("The daemon only supports --auto=ratio with no tolerance.");
+            }
+            Client client(args[1]);
+            client.setChecksums(checksums);
+            client.setMode(mode);
+
+            if (operation == "compress" && args.size() == 5) {
+                client.compress(args[3], args[4]);
+                std::cout << "Compression completed: " << args[4] << std::endl;
+            } else if (operation == "decompress" && args.size() == 5) {
+                client.decompress(args[3], args[4]);
+                std::cout << "Decompression completed: " << args[4] << std::endl;
+            } else if (operation == "verify" && args.size() == 4) {
+                client.verify(args[3]);
+                std::cout << "Verification passed: " << args[3] << std::endl;
+            } else {
+                std::cerr << "Unknown command: " << operation << "\n";
+                printInstructions();
+                return 1;
+            }
         } else {
             std::cerr << "Unknown command: " << command << "\n";
             printInstructions();
@@ -43,4 +224,4 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
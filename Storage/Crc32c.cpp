@@ -0,0 +1,134 @@
+#include "Crc32c.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC32C_X86
+#elif defined(__aarch64__) || defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM
+#if !defined(__ARM_FEATURE_CRC32) && defined(__linux__)
+// the default aarch64 build doesn't assume the CRC instructions, so ask the kernel at run time
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define CRC32C_ARM_RUNTIME
+#endif
+#endif
+
+// reflected CRC32C polynomial
+static const uint32_t POLYNOMIAL = 0x82F63B78;
+
+/**
+ * Builds the lookup table for the software version, one entry per byte value
+ */
+struct Crc32cTable {
+    uint32_t entries[256];
+
+    Crc32cTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? (crc >> 1) ^ POLYNOMIAL : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+/**
+ * Software CRC32C, works a byte at a time through the lookup table
+ */
+static uint32_t crc32cTable(uint32_t crc, const unsigned char *data, size_t size) {
+    static const Crc32cTable table;
+    while (size-- > 0) {
+        crc = table.entries[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(CRC32C_X86)
+/**
+ * SSE4.2 CRC32C, works 8 bytes at a time then finishes off the tail byte by byte
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(uint32_t crc, const unsigned char *data, size_t size) {
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+
+// check the CPU once rather than on every call
+static const bool hardware_supported = __builtin_cpu_supports("sse4.2");
+#elif defined(CRC32C_ARM)
+/**
+ * ARMv8 CRC32C, works 8 bytes at a time then finishes off the tail byte by byte.
+ * Compiled with the CRC extension even when the rest of the build isn't, and only
+ * called once the CPU is known to have it.
+ */
+#if defined(__ARM_FEATURE_CRC32)
+#elif defined(__clang__)
+__attribute__((target("crc")))
+#else
+__attribute__((target("+crc")))
+#endif
+static uint32_t crc32cHardware(uint32_t crc, const unsigned char *data, size_t size) {
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = __crc32cb(crc, *data++);
+    }
+    return crc;
+}
+
+#if defined(CRC32C_ARM_RUNTIME)
+// check the CPU once rather than on every call
+static const bool hardware_supported = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#elif defined(__ARM_FEATURE_CRC32)
+// the instructions were enabled at compile time, so they are always there
+static const bool hardware_supported = true;
+#else
+// no way to ask the CPU on this platform, so stay on the safe side
+static const bool hardware_supported = false;
+#endif
+#endif
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    // the checksum is stored inverted, so undo that while we work on it
+    crc = ~crc;
+#if defined(CRC32C_X86) || defined(CRC32C_ARM)
+    if (hardware_supported) {
+        return ~crc32cHardware(crc, bytes, size);
+    }
+#endif
+    return ~crc32cTable(crc, bytes, size);
+}
+
+uint32_t crc32cSoftware(uint32_t crc, const void *data, size_t size) {
+    return ~crc32cTable(~crc, static_cast<const unsigned char *>(data), size);
+}
+
+bool crc32cHardwareSupported() {
+#if defined(CRC32C_X86) || defined(CRC32C_ARM)
+    return hardware_supported;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,35 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+/**
+ * Computes the CRC32C (Castagnoli) checksum of a buffer.
+ * Uses the SSE4.2 crc32 instruction on x86 when the CPU supports it, and the ARMv8 CRC
+ * instructions when the CPU has them: assumed when compiled for them, otherwise checked at
+ * run time with getauxval on Linux aarch64. Falls back to a table driven software version.
+ * @param crc the checksum of the data before this buffer, 0 to start a new checksum
+ * @param data the bytes to checksum
+ * @param size the number of bytes
+ * @return the checksum of all data so far, can be passed back in to continue it
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t size);
+
+/**
+ * Computes the same checksum as crc32c(), but always with the software version.
+ * Useful for checking the hardware versions against.
+ * @param crc the checksum of the data before this buffer, 0 to start a new checksum
+ * @param data the bytes to checksum
+ * @param size the number of bytes
+ * @return the checksum of all data so far, can be passed back in to continue it
+ */
+uint32_t crc32cSoftware(uint32_t crc, const void *data, size_t size);
+
+/**
+ * Tells whether crc32c() uses CRC instructions on this CPU
+ * @return true if a hardware version is in use, false if it falls back to software
+ */
+bool crc32cHardwareSupported();
+
+#endif //CRC32C_H
@@ -1,24 +1,66 @@
 #include "Storage.h"
+#include <algorithm>
+
+// set in the stored header size when the file has checksums
+static const unsigned int CHECKSUM_FLAG = 0x80000000;
+// set in the stored header size when the data is stored as raw bytes
+static const unsigned int STORED_FLAG = 0x40000000;
+// largest header size we will believe when reading, guards against garbage
+static const unsigned int MAX_HEADER_SIZE = 1 << 20;
 
 Storage::Storage() {
     // set the buffer to empty.
     buffer = "";
+    input = nullptr;
+    output = nullptr;
+    block_position = 0;
+    block_size = BLOCK_SIZE;
+    block_index = 0;
+    checksums = false;
+    stored = false;
 }
 
 bool Storage::open(std::string file_name, std::string mode) {
     // Open the file in read or write mode.
     if ("write" == mode ) {
-        this->mode = "write";
         file.open(file_name, std::ios::out | std::ios::binary);
+        return openWriter(file);
     } else if ("read" == mode) {
-        this->mode = "read";
         file.open(file_name, std::ios::in | std::ios::binary);
-    } else {
-        // return false if mode is not set to read or write
-        return false;
+        return openReader(file);
     }
-    // return false if there is a problem opening the file.
-    return !file.fail();
+    // return false if mode is not set to read or write
+    return false;
+}
+
+bool Storage::openReader(std::istream &stream) {
+    mode = "read";
+    buffer = "";
+    block.clear();
+    block_position = 0;
+    block_size = BLOCK_SIZE;
+    block_index = 0;
+    checksums = false;
+    stored = false;
+    input = &stream;
+    output = nullptr;
+    // return false if there is a problem with the stream.
+    return !stream.fail();
+}
+
+bool Storage::openWriter(std::ostream &stream) {
+    mode = "write";
+    buffer = "";
+    block.clear();
+    block_position = 0;
+    block_size = BLOCK_SIZE;
+    block_index = 0;
+    checksums = false;
+    stored = false;
+    input = nullptr;
+    output = &stream;
+    // return false if there is a problem with the stream.
+    return !stream.fail();
 }
 
 bool Storage::close() {
@@ -29,30 +71,93 @@ bool Storage::close() {
         // shift the bits over to pad the end with 0s
         unsigned long shift = 8 - buffer.size();
         bits <<= shift;
-        unsigned long value = bits.to_ulong();
-        file.write(reinterpret_cast<const char*>(&value), 1);
-
+        writeByte(bits.to_ulong());
+    }
+    buffer = "";
+    if (output != nullptr) {
+        // write out the last, possibly partial, block
+        flushBlock();
+        output->flush();
     }
-    // close the file
-    file.close();
+    // close the file if we opened one; borrowed streams are left to their owner
+    if (file.is_open()) {
+        file.close();
+    }
+    input = nullptr;
+    output = nullptr;
     return true;
 }
 
+void Storage::setChecksums(bool enabled) {
+    checksums = enabled;
+}
+
+void Storage::setBlockSize(unsigned int size) {
+    block_size = size;
+}
+
+void Storage::setStored(bool enabled) {
+    stored = enabled;
+}
+
+bool Storage::isStored() {
+    return stored;
+}
+
 void Storage::setHeader(std::string header) {
     unsigned int size = header.size();
-    file.write(reinterpret_cast<const char*>(&size), 4);
-    file << header;
+    if (stored) {
+        size |= STORED_FLAG;
+    }
+    if (!checksums) {
+        output->write(reinterpret_cast<const char*>(&size), 4);
+        *output << header;
+        return;
+    }
 
+    // flag the size so readers know checksums follow, then protect the header itself
+    unsigned int flagged_size = size | CHECKSUM_FLAG;
+    uint32_t crc = crc32c(0, &block_size, 4);
+    crc = crc32c(crc, header.data(), header.size());
+    output->write(reinterpret_cast<const char*>(&flagged_size), 4);
+    output->write(reinterpret_cast<const char*>(&block_size), 4);
+    *output << header;
+    output->write(reinterpret_cast<const char*>(&crc), 4);
 }
 
 std::string Storage::getHeader() {
     unsigned int size;
-    file.read(reinterpret_cast<char *>(&size), 4);
+    if (!input->read(reinterpret_cast<char *>(&size), 4)) {
+        throw std::runtime_error("Corrupt header: file is too short.");
+    }
+
+    // a flagged size means the block size and a checksum come with the header
+    checksums = (size & CHECKSUM_FLAG) != 0;
+    stored = (size & STORED_FLAG) != 0;
+    size &= ~(CHECKSUM_FLAG | STORED_FLAG);
+    if (checksums && !input->read(reinterpret_cast<char *>(&block_size), 4)) {
+        throw std::runtime_error("Corrupt header: file is too short.");
+    }
+    if (size > MAX_HEADER_SIZE || block_size == 0 || block_size > MAX_BLOCK_SIZE) {
+        throw std::runtime_error("Corrupt header: invalid size.");
+    }
 
-    char header[size + 1];
-    file.read(reinterpret_cast<char *>(&header), size);
-    header[size] = '\0';
-    std::string result = std::string(header);
+    // read into a string rather than a stack array so a corrupt size cannot overflow the stack
+    std::string result(size, '\0');
+    if (!input->read(&result[0], size)) {
+        throw std::runtime_error("Corrupt header: file is too short.");
+    }
+
+    if (checksums) {
+        uint32_t expected_crc;
+        if (!input->read(reinterpret_cast<char *>(&expected_crc), 4)) {
+            throw std::runtime_error("Corrupt header: file is too short.");
+        }
+        uint32_t crc = crc32c(0, &block_size, 4);
+        if (crc32c(crc, result.data(), result.size()) != expected_crc) {
+            throw std::runtime_error("Corrupt header: checksum mismatch.");
+        }
+    }
     return result;
 }
 
@@ -71,20 +176,19 @@ void Storage::insert(std::string binary_string) {
         // save them in a bitset
         std::bitset<8> bits(bit_string);
         // store the value of the bits
-        unsigned long value = bits.to_ulong();
-        file.write(reinterpret_cast<const char*>(&value), 1);
+        writeByte(bits.to_ulong());
     }
 }
 
 
 bool Storage::extract(std::string &binary_string) {
-    // read the next 8 bits in to a char variable.
-    unsigned char p;
-    file.read(reinterpret_cast<char *>(&p), 1);
+    // move on to the next block once this one is used up
     // if it's the end of the file return false
-    if (file.eof()) {
+    if (block_position == block.size() && !readBlock()) {
         return false;
     }
+    // read the next 8 bits in to a char variable.
+    unsigned char p = block[block_position++];
     // convert the char to a bitset
     std::bitset<8> bits(p);
     // convert the bitset to a binary string
@@ -93,3 +197,72 @@ bool Storage::extract(std::string &binary_string) {
     // return true for success
     return true;
 }
+
+void Storage::insertBytes(const char *bytes, size_t size) {
+    // fill up blocks a piece at a time, writing each one out as it fills
+    while (size > 0) {
+        size_t count = std::min<size_t>(size, block_size - block.size());
+        block.append(bytes, count);
+        bytes += count;
+        size -= count;
+        if (block.size() == block_size) {
+            flushBlock();
+        }
+    }
+}
+
+bool Storage::extractBytes(std::string &bytes) {
+    // move on to the next block once this one is used up
+    if (block_position == block.size() && !readBlock()) {
+        return false;
+    }
+    // hand back whatever is left of the current block
+    bytes.assign(block, block_position, std::string::npos);
+    block_position = block.size();
+    return true;
+}
+
+void Storage::writeByte(unsigned char value) {
+    block.push_back(value);
+    if (block.size() == block_size) {
+        flushBlock();
+    }
+}
+
+void Storage::flushBlock() {
+    if (block.empty()) {
+        return;
+    }
+    output->write(block.data(), block.size());
+    if (checksums) {
+        uint32_t crc = crc32c(0, block.data(), block.size());
+        output->write(reinterpret_cast<const char*>(&crc), 4);
+    }
+    block.clear();
+}
+
+bool Storage::readBlock() {
+    // a stored block is its data followed by the checksum, if there is one
+    unsigned int trailer = checksums ? 4 : 0;
+    block.resize(block_size + trailer);
+    input->read(&block[0], block.size());
+    block.resize(input->gcount());
+    block_position = 0;
+    if (block.empty()) {
+        return false;
+    }
+    block_index++;
+
+    if (checksums) {
+        if (block.size() <= trailer) {
+            throw std::runtime_error("Corrupt data: block " + std::to_string(block_index) + " is truncated.");
+        }
+        uint32_t expected_crc;
+        block.copy(reinterpret_cast<char *>(&expected_crc), trailer, block.size() - trailer);
+        block.resize(block.size() - trailer);
+        if (crc32c(0, block.data(), block.size()) != expected_crc) {
+            throw std::runtime_error("Corrupt data: checksum mismatch in block " + std::to_string(block_index) + ".");
+        }
+    }
+    return true;
+}
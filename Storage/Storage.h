@@ -4,6 +4,8 @@
 #include <bitset>
 #include <iostream>
 #include <ios>
+#include <stdexcept>
+#include "Crc32c.h"
 
 #ifndef STORAGE_H
 #define STORAGE_H
@@ -13,6 +15,14 @@
  * This Class is intended to be used with the Huffman lab to store the results of a Huffman
  * compressed string.
  * For an example of using the Storage class see the StorageDriver.cpp file.
+ *
+ * Data bytes are written and read in blocks. When checksums are turned on, each block is
+ * followed by its CRC32C so damage can be detected while reading, and the header is stored as:
+ * [4 byte size with the top bit set][4 byte block size][header][4 byte CRC32C of the previous two]
+ * Files without checksums keep the original [4 byte size][header] layout.
+ * The second highest bit of the size marks a stored file, whose data was written with
+ * insertBytes rather than as a binary string. Its header holds the 8 byte data length instead
+ * of a code table, so that truncated or padded data can be detected.
  */
 class Storage {
 public:
@@ -25,6 +35,51 @@ public:
      */
     bool open(std::string file_name, std::string mode);
 
+    /**
+     * Reads from an already open stream instead of a file. The stream is not owned and
+     * must outlive the storage until close() is called.
+     * @param stream the stream to read the header and binary data from
+     * @return True if the stream is usable, false if something goes wrong
+     */
+    bool openReader(std::istream &stream);
+
+    /**
+     * Writes to an already open stream instead of a file. The stream is not owned and
+     * must outlive the storage until close() is called.
+     * @param stream the stream to write the header and binary data to
+     * @return True if the stream is usable, false if something goes wrong
+     */
+    bool openWriter(std::ostream &stream);
+
+    /**
+     * Turns per block checksums on or off for the file being written.
+     * Note: must be called after open and before setHeader.
+     * @param enabled true to store a CRC32C after every block
+     */
+    void setChecksums(bool enabled);
+
+    /**
+     * Sets how many data bytes go in each block of the file being written.
+     * Note: must be called after open and before setHeader.
+     * @param size bytes per block, between 1 and MAX_BLOCK_SIZE
+     */
+    void setBlockSize(unsigned int size);
+
+    /**
+     * Marks the file being written as stored, meaning its data is raw bytes from insertBytes.
+     * Note: must be called after open and before setHeader.
+     * @param enabled true to mark the file as stored
+     */
+    void setStored(bool enabled);
+
+    /**
+     * Tells whether the file being read was marked as stored.
+     * Note: only valid after getHeader.
+     * @return true if the file's data is raw bytes to be read with extractBytes
+     * @see setStored
+     */
+    bool isStored();
+
     /**
      * Flushes buffer and closes the file
      * @return
@@ -40,7 +95,9 @@ public:
 
     /**
      * reads and returns a header string from a file.
+     * Also detects whether the file has checksums.
      * @return header string
+     * @throws std::runtime_error if the header is damaged
      * @see setHeader
      */
     std::string getHeader();
@@ -55,13 +112,61 @@ public:
      * Returns the next 8 bits of a binary string
      * @param binary_string The binary string is passed back through the pass by reference parameter
      * @return true as long as there is more to read in the file and false when the end of the file is reached
+     * @throws std::runtime_error if a block fails its checksum or is cut short
      */
     bool extract(std::string &binary_string);
 
+    /**
+     * Stores raw bytes as they are, for data that isn't a binary string.
+     * Note: don't mix with insert() in the same file.
+     * @param bytes the bytes to store
+     * @param size the number of bytes
+     */
+    void insertBytes(const char *bytes, size_t size);
+
+    /**
+     * Returns the next run of raw bytes, up to the end of the current block
+     * Note: don't mix with extract() in the same file.
+     * @param bytes The bytes are passed back through the pass by reference parameter
+     * @return true as long as there is more to read in the file and false when the end of the file is reached
+     * @throws std::runtime_error if a block fails its checksum or is cut short
+     */
+    bool extractBytes(std::string &bytes);
+
+
+    // number of data bytes per block unless setBlockSize is called
+    static const unsigned int BLOCK_SIZE = 1 << 16;
+    // largest block size allowed
+    static const unsigned int MAX_BLOCK_SIZE = 1 << 26;
 
 private:
+    /**
+     * Adds a byte to the current block, writing the block out once it is full
+     * @param value the byte to write
+     */
+    void writeByte(unsigned char value);
+
+    /**
+     * Writes the current block, followed by its checksum if checksums are on
+     */
+    void flushBlock();
+
+    /**
+     * Reads the next block into the block buffer and checks its checksum if checksums are on
+     * @return true if a block was read, false at the end of the file
+     */
+    bool readBlock();
+
     std::string buffer;
+    std::string block;          // data bytes of the current block
+    size_t block_position;      // next byte of the block to extract when reading
+    unsigned int block_size;    // size of a full block in the current file
+    unsigned int block_index;   // number of blocks read so far, used in error messages
+    bool checksums;             // true if blocks are followed by a CRC32C
+    bool stored;                // true if the data is raw bytes rather than a binary string
     std::fstream file;
+    std::istream *input;
+    std::ostream *output;
     std::string mode;
 
 
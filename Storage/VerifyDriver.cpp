@@ -0,0 +1,227 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include "Crc32c.h"
+#include "Storage.h"
+#include "../Huffman.h"
+
+// number of checks that failed
+static int failures = 0;
+
+/**
+ * Records the result of a check and prints it
+ * @param passed whether the check passed
+ * @param name what was checked
+ */
+void check(bool passed, const std::string &name) {
+    std::cout << (passed ? "PASS: " : "FAIL: ") << name << std::endl;
+    if (!passed) {
+        failures++;
+    }
+}
+
+/**
+ * Builds a compressed file without checksums out of a raw header and data bytes
+ * @param header the header, in [char][Huffman code][\36] format
+ * @param data the bytes that follow the header
+ * @return the file's contents
+ */
+std::string makeFile(const std::string &header, const std::string &data) {
+    unsigned int size = header.size();
+    return std::string(reinterpret_cast<const char *>(&size), 4) + header + data;
+}
+
+/**
+ * Compresses a string in memory
+ * @param text the text to compress
+ * @param checksums whether to store checksums
+ * @param mode the coding mode
+ * @return the compressed contents
+ */
+std::string compressText(const std::string &text, bool checksums, const std::string &mode = "huffman") {
+    Huffman huffman;
+    huffman.setChecksums(checksums);
+    huffman.setMode(mode);
+    std::istringstream input(text);
+    std::ostringstream output;
+    huffman.compress(input, output);
+    return output.str();
+}
+
+/**
+ * Compresses a string in memory with "auto" and returns what it chose
+ * @param text the text to compress
+ * @param tolerance the ratio loss allowed, see Huffman::setTolerance
+ * @param checksums whether to store checksums
+ * @return the stats of the compression
+ */
+Huffman::Stats compressAuto(const std::string &text, double tolerance, bool checksums = false) {
+    Huffman huffman;
+    huffman.setChecksums(checksums);
+    huffman.setMode("auto");
+    huffman.setTolerance(tolerance);
+    std::istringstream input(text);
+    std::ostringstream output;
+    huffman.compress(input, output);
+    return huffman.getStats();
+}
+
+/**
+ * Checks that setTolerance refuses a value
+ * @param percent the tolerance to try
+ * @param name what was checked
+ */
+void checkToleranceRejected(double percent, const std::string &name) {
+    Huffman huffman;
+    try {
+        huffman.setTolerance(percent);
+        check(false, name);
+    } catch (const std::runtime_error &) {
+        check(true, name);
+    }
+}
+
+/**
+ * Runs Huffman::verify over some compressed contents
+ * @param contents the compressed contents
+ * @param error the error message is passed back through the pass by reference parameter
+ * @return true if verify accepted the contents, false if it threw
+ */
+bool verifies(const std::string &contents, std::string &error) {
+    Huffman huffman;
+    std::istringstream input(contents);
+    try {
+        huffman.verify(input);
+    } catch (const std::runtime_error &e) {
+        error = e.what();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Checks that verify rejects some contents with an error mentioning the expected text
+ * @param contents the compressed contents
+ * @param expected part of the expected error message
+ * @param name what was checked
+ */
+void checkRejected(const std::string &contents, const std::string &expected, const std::string &name) {
+    std::string error;
+    bool rejected = !verifies(contents, error);
+    check(rejected && error.find(expected) != std::string::npos, name + " (" + error + ")");
+}
+
+int main() {
+    // the standard CRC32C check value
+    check(crc32c(0, "123456789", 9) == 0xE3069283, "crc32c check value");
+    check(crc32cSoftware(0, "123456789", 9) == 0xE3069283, "software crc32c check value");
+    check(crc32c(crc32c(0, "1234", 4), "56789", 5) == 0xE3069283, "crc32c continues across calls");
+
+    // the hardware version must agree with the software one at every length and alignment
+    std::cout << "hardware crc32c: " << (crc32cHardwareSupported() ? "yes" : "no") << std::endl;
+    std::string bytes;
+    for (int i = 0; i < 1100; i++) {
+        bytes.push_back(static_cast<char>(i * 131 + 7));
+    }
+    bool agree = true;
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t size = 0; size + offset <= bytes.size(); size += 13) {
+            agree = agree && crc32c(0, bytes.data() + offset, size)
+                             == crc32cSoftware(0, bytes.data() + offset, size);
+        }
+    }
+    check(agree, "hardware and software crc32c agree");
+
+    // a good file verifies, with and without checksums
+    std::string text;
+    for (int i = 0; i < 20000; i++) {
+        text += "the quick brown fox jumps over the lazy dog " + std::to_string(i) + "\n";
+    }
+    std::string plain = compressText(text, false);
+    std::string checked = compressText(text, true);
+    std::string error;
+    check(verifies(plain, error), "file without checksums verifies");
+    check(verifies(checked, error), "file with checksums verifies");
+    check(checked.size() > Storage::BLOCK_SIZE * 2, "file with checksums spans several blocks");
+
+    // a flipped byte in a data block or the header is caught by its checksum
+    std::string damaged = checked;
+    damaged[damaged.size() / 2] ^= 0x10;
+    checkRejected(damaged, "checksum mismatch in block", "flipped data byte");
+    damaged = checked;
+    damaged[12] ^= 0x01;
+    checkRejected(damaged, "Corrupt header: checksum mismatch", "flipped header byte");
+
+    // structural damage is caught with or without checksums
+    checkRejected(plain.substr(0, plain.size() / 2), "missing end of stream", "truncated data");
+    checkRejected(plain + "extra", "unexpected bytes after end of stream", "trailing data");
+    checkRejected(std::string("\xff\xff\xff\x0f", 4) + plain.substr(4), "Corrupt header: invalid size", "huge header size");
+    checkRejected(plain.substr(0, 2), "file is too short", "truncated size field");
+    checkRejected(makeFile("a0\36\3" "12\36", "\x40"), "Corrupt header: invalid code", "non binary code in header");
+    checkRejected(makeFile("a0\36b0\36\3" "1\36", "\x80"), "Corrupt header: conflicting codes", "two chars with one code");
+    checkRejected(makeFile("a0\36b01\36\3" "1\36", "\x80"), "Corrupt header: conflicting codes", "code through a leaf");
+    // "01" leads from the inner node at "0" to a branch that doesn't exist
+    checkRejected(makeFile("a00\36\3" "1\36", "\x40"), "Corrupt data: invalid code", "bits matching no code");
+
+    // stored files are marked by a flag, so a zeroed size doesn't pass as stored data
+    check(verifies(compressText(text, false, "stored"), error), "stored file verifies");
+    check(verifies(compressText(text, true, "stored"), error), "stored file with checksums verifies");
+    checkRejected(std::string(4, '\0') + plain.substr(4), "Corrupt header: empty code table", "zeroed header size");
+
+    // stored data has no end marker, so its length in the header is what catches truncation
+    // a checksummed stored header is [size][block size][8 byte length][CRC32C], and every block checks out on its own
+    std::string stored_plain = compressText(text, false, "stored");
+    std::string stored_checked = compressText(text, true, "stored");
+    size_t stored_header = 4 + 4 + 8 + 4;
+    checkRejected(stored_checked.substr(0, stored_header + Storage::BLOCK_SIZE + 4), "stored data is truncated",
+                  "stored file cut at a block boundary");
+    checkRejected(stored_checked.substr(0, stored_header), "stored data is truncated", "stored file cut after its header");
+    checkRejected(stored_plain.substr(0, 100000), "stored data is truncated", "truncated stored file");
+    checkRejected(stored_plain + "extra", "unexpected bytes after end of stream", "stored file with trailing data");
+    checkRejected(std::string("\x01\x00\x00\x40", 4) + plain.substr(4), "Corrupt header: stored data with a code table",
+                  "stored flag on coded data");
+
+    // auto stores what Huffman coding can't shrink, and codes what it can
+    // pseudo random bytes, skipping the NUL and ETX bytes that would force stored mode on their own
+    std::string noise;
+    std::string base64;
+    unsigned int seed = 12345;
+    while (noise.size() < 200000) {
+        seed = seed * 1103515245 + 12345;
+        char next = static_cast<char>(seed >> 16);
+        if (next != '\0' && next != '\x03') {
+            noise.push_back(next);
+        }
+        base64.push_back("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[(seed >> 16) % 64]);
+    }
+    Huffman::Stats stats = compressAuto(noise, 0);
+    check(stats.automatic && stats.mode == "stored", "auto stores random bytes (" + stats.reason + ")");
+    stats = compressAuto(text, 0);
+    check(stats.mode == "huffman", "auto codes text (" + stats.reason + ")");
+    stats = compressAuto(text + '\0', 0);
+    check(stats.mode == "stored" && stats.reason.find("cannot code") != std::string::npos,
+          "auto stores input containing NUL (" + stats.reason + ")");
+
+    // 64 symbols code to about 0.75, and stored is 33% worse than that
+    stats = compressAuto(base64, 30);
+    check(stats.mode == "huffman", "stored more than 30% worse is not within ratio:30");
+    stats = compressAuto(base64, 40);
+    check(stats.mode == "stored", "stored less than 40% worse is within ratio:40");
+
+    // only checksummed files record a block size
+    check(compressAuto(text, 0).block_size == 0, "auto reports no block size without checksums");
+    check(compressAuto(text, 0, true).block_size >= Storage::BLOCK_SIZE, "auto picks a block size with checksums");
+
+    checkToleranceRejected(std::nan(""), "NaN tolerance is rejected");
+    checkToleranceRejected(-1, "negative tolerance is rejected");
+    checkToleranceRejected(101, "tolerance over 100 is rejected");
+
+    if (failures > 0) {
+        std::cout << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}